@@ -5,11 +5,62 @@
 #include <homekit/characteristics.h>
 #include <homekit/homekit.h>
 #include <stdio.h>
+#include <task.h>
 
+#include "budget.h"
 #include "machine.h"
 #include "timed_latch.h"
 #include "transitions.h"
 
+// Stack, in words, for the notify task. It runs homekit_characteristic_notify
+// and printf, neither has been measured on a device yet, so this is generous
+// until the high water mark logged on identify has been read from one. The
+// task also warns once if less than ACCESSORY_NOTIFY_STACK_HEADROOM words were
+// ever left unused.
+#define ACCESSORY_NOTIFY_STACK_SIZE 1024
+#define ACCESSORY_NOTIFY_STACK_HEADROOM 256
+
+static bool g_fault;
+// Notifications are skipped until the HomeKit server is started, controllers
+// read the current values on connect
+static bool g_started;
+
+// Each characteristic has a single pending notification slot. An event that
+// arrives before the previous one was handed to the HomeKit server replaces
+// it, so callbacks never wait on the server and it is only handed the latest
+// value.
+typedef enum {
+  ACCESSORY_NOTIFY_CURRENT_STATE = 0,
+  ACCESSORY_NOTIFY_TARGET_STATE,
+  ACCESSORY_NOTIFY_OBSTRUCTION,
+  ACCESSORY_NOTIFY_COUNT,
+} accessory_notification_id_t;
+
+typedef struct accessory_notification_t {
+  homekit_characteristic_t *characteristic;
+  homekit_value_t value;
+  homekit_value_t sent_value;
+  bool pending;
+  bool sent;
+} accessory_notification_t;
+
+static accessory_notification_t g_notifications[ACCESSORY_NOTIFY_COUNT];
+static uint32_t g_merged_notifications;
+static uint32_t g_skipped_notifications;
+static TaskHandle_t g_notify_task;
+
+// Times handing values to the HomeKit server, not their delivery to controllers
+static budget_site_t g_notify_budget = BUDGET_SITE("notify");
+static budget_site_t g_get_current_state_budget =
+    BUDGET_SITE("get current state");
+static budget_site_t g_get_target_state_budget =
+    BUDGET_SITE("get target state");
+static budget_site_t g_set_target_state_budget =
+    BUDGET_SITE("set target state");
+static budget_site_t g_identify_budget = BUDGET_SITE("identify");
+static budget_site_t g_get_obstruction_budget =
+    BUDGET_SITE("get obstruction");
+
 static uint8_t
 accessory_target_state_from_state(machine_state_t machine_state) {
   const char state_map[] = {
@@ -25,42 +76,133 @@ accessory_target_state_from_state(machine_state_t machine_state) {
 }
 
 static homekit_value_t accessory_get_current_state() {
+  uint32_t started = budget_start();
   machine_state_t current_state = machine_current_state();
   printf("Returning current door state '%s'.\n",
          machine_state_description(current_state));
 
+  budget_stop(&g_get_current_state_budget, started);
   return HOMEKIT_UINT8(current_state);
 }
 
 static homekit_value_t accessory_get_target_state() {
+  uint32_t started = budget_start();
   machine_state_t target_state =
       accessory_target_state_from_state(machine_current_state());
 
   printf("Returning target door state '%s'.\n",
          machine_state_description(target_state));
 
+  budget_stop(&g_get_target_state_budget, started);
   return HOMEKIT_UINT8(target_state);
 }
 
 static void accessory_set_target_state(homekit_value_t new_value) {
+  uint32_t started = budget_start();
+
   if (new_value.format != homekit_format_uint8) {
     printf("Invalid value format: %d\n", new_value.format);
-    return;
+  } else {
+    // TODO: Handle unknown - need a better solution for MACHINE_STATE_UNKNOWN
+    // == 255 with sparse arrays
+    machine_handle_event(new_value.uint8_value);
   }
 
-  // TODO: Handle unknown - need a better solution for MACHINE_STATE_UNKNOWN ==
-  // 255 with sparse arrays
-  machine_handle_event(new_value.uint8_value);
+  budget_stop(&g_set_target_state_budget, started);
 }
 
 static void accessory_identify() {
+  uint32_t started = budget_start();
   // TODO: Implement identify function
   printf("Identify\n");
+  // Stopped before reporting so printing the report is not counted as a stall
+  budget_stop(&g_identify_budget, started);
+
+  budget_report();
+  printf("Notifications merged=%u unchanged=%u\n", g_merged_notifications,
+         g_skipped_notifications);
+  printf("Notify task stack high water mark %u of %u words\n",
+         uxTaskGetStackHighWaterMark(g_notify_task),
+         ACCESSORY_NOTIFY_STACK_SIZE);
 }
 
+// Sensor faults are reported as an obstruction as it is the only fault
+// indication the Home app shows for a garage door opener
 static homekit_value_t accessory_get_obstruction() {
-  // TODO: Implement obstruction sensor
-  return HOMEKIT_BOOL(false);
+  uint32_t started = budget_start();
+  bool obstruction = g_fault;
+
+  budget_stop(&g_get_obstruction_budget, started);
+  return HOMEKIT_BOOL(obstruction);
+}
+
+static bool accessory_value_equal(homekit_value_t a, homekit_value_t b) {
+  if (a.format != b.format) {
+    return false;
+  }
+
+  return a.format == homekit_format_bool ? a.bool_value == b.bool_value
+                                         : a.uint8_value == b.uint8_value;
+}
+
+static void accessory_queue_notification(accessory_notification_id_t id,
+                                         homekit_characteristic_t *ch,
+                                         homekit_value_t value) {
+  accessory_notification_t *notification = &g_notifications[id];
+
+  taskENTER_CRITICAL();
+  if (notification->pending) {
+    g_merged_notifications++;
+  }
+  notification->characteristic = ch;
+  notification->value = value;
+  notification->pending = true;
+  taskEXIT_CRITICAL();
+
+  xTaskNotifyGive(g_notify_task);
+}
+
+static void accessory_notify_task(void *arg) {
+  bool warned = false;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t started = budget_start();
+
+    for (int id = 0; id < ACCESSORY_NOTIFY_COUNT; id++) {
+      accessory_notification_t *notification = &g_notifications[id];
+
+      taskENTER_CRITICAL();
+      bool pending = notification->pending;
+      homekit_value_t value = notification->value;
+      notification->pending = false;
+      taskEXIT_CRITICAL();
+
+      if (!pending) {
+        continue;
+      }
+
+      // A value that has not changed since it was last sent is not sent again
+      if (notification->sent &&
+          accessory_value_equal(notification->sent_value, value)) {
+        g_skipped_notifications++;
+        continue;
+      }
+
+      homekit_characteristic_notify(notification->characteristic, value);
+      notification->sent_value = value;
+      notification->sent = true;
+    }
+
+    budget_stop(&g_notify_budget, started);
+
+    if (!warned && uxTaskGetStackHighWaterMark(NULL) <
+                       ACCESSORY_NOTIFY_STACK_HEADROOM) {
+      printf("Notify task has %u words of stack left\n",
+             uxTaskGetStackHighWaterMark(NULL));
+      warned = true;
+    }
+  }
 }
 
 static void accessory_handle_transition(machine_state_t new_state) {
@@ -122,9 +264,9 @@ void accessory_init(const accessory_config_t *config,
   //          mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4],
   //          mac_addr[5]);
 
-  transition_init(config->movement_timeout, config->reverse_delay);
-  machine_init(g_state_transition_matrix, initial_state,
-               accessory_handle_transition);
+  machine_state_t state =
+      transition_start(config->movement_timeout, config->reverse_delay,
+                       initial_state, accessory_handle_transition);
 
   g_accessory_config.password = config->password;
   homekit_accessory_t *accessory = g_accessory_config.accessories[0];
@@ -142,10 +284,21 @@ void accessory_init(const accessory_config_t *config,
       HOMEKIT_STRING(config->version);
 
   garage_door_service->characteristics[0]->value = HOMEKIT_STRING(config->name);
-  garage_door_service->characteristics[1]->value = HOMEKIT_UINT8(initial_state);
-  garage_door_service->characteristics[2]->value = HOMEKIT_UINT8(initial_state);
+  garage_door_service->characteristics[1]->value = HOMEKIT_UINT8(state);
+  garage_door_service->characteristics[2]->value = HOMEKIT_UINT8(state);
+}
 
+void accessory_start() {
+  assert(!g_started);
   homekit_server_init(&g_accessory_config);
+
+  BaseType_t result =
+      xTaskCreate(accessory_notify_task, "HomeKit notify",
+                  ACCESSORY_NOTIFY_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1,
+                  &g_notify_task);
+  assert(result == pdPASS);
+
+  g_started = true;
 }
 
 void accessory_notify_state() {
@@ -161,6 +314,10 @@ void accessory_notify_state() {
   assert(current);
   assert(target);
 
+  if (!g_started) {
+    return;
+  }
+
   if (current_state != target_state) {
     printf("Notifying homekit that current door state is '%s' with a target of "
            "'%s'\n",
@@ -171,6 +328,28 @@ void accessory_notify_state() {
            machine_state_description(current_state));
   }
 
-  homekit_characteristic_notify(current, HOMEKIT_UINT8(current_state));
-  homekit_characteristic_notify(target, HOMEKIT_UINT8(target_state));
+  accessory_queue_notification(ACCESSORY_NOTIFY_CURRENT_STATE, current,
+                               HOMEKIT_UINT8(current_state));
+  accessory_queue_notification(ACCESSORY_NOTIFY_TARGET_STATE, target,
+                               HOMEKIT_UINT8(target_state));
+}
+
+void accessory_notify_fault(bool faulted) {
+  homekit_accessory_t *accessories = g_accessory_config.accessories[0];
+  homekit_service_t *service = accessories->services[1];
+  homekit_characteristic_t *obstruction = service->characteristics[3];
+
+  assert(obstruction);
+
+  g_fault = faulted;
+
+  if (!g_started) {
+    return;
+  }
+
+  printf("Notifying homekit that door sensors are %s\n",
+         faulted ? "faulted" : "healthy");
+
+  accessory_queue_notification(ACCESSORY_NOTIFY_OBSTRUCTION, obstruction,
+                               HOMEKIT_BOOL(faulted));
 }
@@ -18,6 +18,8 @@ typedef struct accessory_config_t {
 
 void accessory_init(const accessory_config_t *config,
                     const machine_state_t initial_state);
+void accessory_start();
 void accessory_notify_state();
+void accessory_notify_fault(bool faulted);
 
 #endif /* ACCESSORY_H */
@@ -0,0 +1,48 @@
+#include "budget.h"
+
+#include <espressif/esp_system.h>
+#include <stdio.h>
+#include <task.h>
+
+static budget_site_t *gp_sites;
+
+static void budget_register(budget_site_t *site) {
+  taskENTER_CRITICAL();
+  if (!site->registered) {
+    site->next = gp_sites;
+    site->registered = true;
+    gp_sites = site;
+  }
+  taskEXIT_CRITICAL();
+}
+
+uint32_t budget_start() { return sdk_system_get_time(); }
+
+void budget_stop(budget_site_t *site, uint32_t started) {
+  // Unsigned subtraction handles the microsecond counter wrapping
+  uint32_t duration = sdk_system_get_time() - started;
+
+  if (!site->registered) {
+    budget_register(site);
+  }
+
+  site->calls++;
+  if (duration > site->worst) {
+    site->worst = duration;
+  }
+
+  if (duration > CALLBACK_BUDGET) {
+    site->violations++;
+    printf("Callback '%s' stalled for %uus, exceeding budget of %uus\n",
+           site->name, duration, CALLBACK_BUDGET);
+  }
+}
+
+void budget_report() {
+  printf("Callback budget report (budget %uus):\n", CALLBACK_BUDGET);
+
+  for (budget_site_t *site = gp_sites; site != NULL; site = site->next) {
+    printf("  %s: calls=%u violations=%u worst=%uus\n", site->name,
+           site->calls, site->violations, site->worst);
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <FreeRTOS.h>
+
+// Execution time budget, in microseconds, for callbacks running on the timer
+// service or HomeKit server tasks
+#ifndef CALLBACK_BUDGET
+#define CALLBACK_BUDGET 20000
+#endif
+
+typedef struct budget_site_t {
+  const char *name;
+  uint32_t calls;
+  uint32_t violations;
+  uint32_t worst;
+  bool registered;
+  struct budget_site_t *next;
+} budget_site_t;
+
+#define BUDGET_SITE(site_name)                                                 \
+  { .name = site_name }
+
+uint32_t budget_start();
+void budget_stop(budget_site_t *site, uint32_t started);
+// Prints every site over the UART, which takes milliseconds, so it must not be
+// called from the timer service task
+void budget_report();
+
+#endif /* BUDGET_H */
@@ -1,9 +1,16 @@
 #include "door.h"
 
 #include <assert.h>
+#include <etstimer.h>
+#include <espressif/esp_misc.h>
+#include <espressif/esp_system.h>
 #include <stdio.h>
+#include <task.h>
 #include <toggle.h>
 
+#include "budget.h"
+#include "probe.h"
+
 // Reed switches are Normally-Open and configured with pull-up resistor so a
 // high input indicates sensor not-triggered - should be made configurable to
 // support different switch configurations
@@ -15,7 +22,17 @@ static uint8_t g_top_sensor_gpio;
 static sensor_state_t g_top_sensor_state;
 static sensor_state_t g_bottom_sensor_state;
 
+static probe_health_t g_top_sensor_health;
+static probe_health_t g_bottom_sensor_health;
+
 static door_callback_fn g_on_door_state_changed;
+static door_fault_fn g_on_door_fault_changed;
+
+static ETSTimer g_probe_timer;
+static uint32_t g_last_sensor_change;
+
+static budget_site_t g_sensor_change_budget = BUDGET_SITE("sensor change");
+static budget_site_t g_sensor_probe_budget = BUDGET_SITE("sensor probe");
 
 const char *sensor_description(uint8_t sensor_gpio) {
   const char *description = "unknown";
@@ -62,7 +79,40 @@ void reset_sensor_state() {
   g_top_sensor_state = gpio_read(g_top_sensor_gpio);
 }
 
+static probe_health_t *sensor_health(uint8_t sensor_gpio) {
+  probe_health_t *health = NULL;
+
+  if (sensor_gpio == g_bottom_sensor_gpio) {
+    health = &g_bottom_sensor_health;
+  } else if (sensor_gpio == g_top_sensor_gpio) {
+    health = &g_top_sensor_health;
+  }
+
+  return health;
+}
+
+// Returns true when the sensor's health changed
+static bool sensor_record_probe(uint8_t sensor_gpio, probe_result_t result) {
+  probe_health_t *health = sensor_health(sensor_gpio);
+  assert(health);
+
+  // An uncalibrated probe only logs, it never affects sensor health
+  if (!probe_enabled()) {
+    return false;
+  }
+
+  bool changed = probe_record(health, result);
+
+  if (changed) {
+    printf("%s(%d) sensor %s\n", sensor_description(sensor_gpio), sensor_gpio,
+           health->disconnected ? "disconnected" : "reconnected");
+  }
+
+  return changed;
+}
+
 static void on_sensor_change(bool high, void *p_sensor_gpio) {
+  uint32_t started = budget_start();
   uint8_t sensor_gpio = *((uint8_t *)p_sensor_gpio);
   sensor_state_t sensor_state = high;
   if (sensor_gpio == g_bottom_sensor_gpio) {
@@ -71,6 +121,14 @@ static void on_sensor_change(bool high, void *p_sensor_gpio) {
     g_top_sensor_state = sensor_state;
   }
 
+  g_last_sensor_change = sdk_system_get_time();
+
+  // A closed switch proves the wiring is intact
+  if (sensor_state == SENSOR_CLOSED &&
+      sensor_record_probe(sensor_gpio, PROBE_CONNECTED)) {
+    g_on_door_fault_changed(door_faulted());
+  }
+
   printf("%s(%d) sensor %s\n", sensor_description(sensor_gpio), sensor_gpio,
          sensor_state_description(sensor_state));
 
@@ -79,6 +137,77 @@ static void on_sensor_change(bool high, void *p_sensor_gpio) {
   printf("Door appears to be %s\n", door_state_description(door_state));
 
   g_on_door_state_changed(door_state);
+
+  budget_stop(&g_sensor_change_budget, started);
+}
+
+// Returns the number of polls taken for the line to rise, or -1 when the
+// switch closed during the probe
+static int sensor_probe_rise(uint8_t sensor_gpio) {
+  int rise = 0;
+
+  // Runs in a critical section so the toggle poller can never observe the
+  // discharged line
+  taskENTER_CRITICAL();
+  gpio_write(sensor_gpio, false);
+  gpio_enable(sensor_gpio, GPIO_OUTPUT);
+  sdk_os_delay_us(SENSOR_PROBE_DISCHARGE);
+  gpio_enable(sensor_gpio, GPIO_INPUT);
+  gpio_set_pullup(sensor_gpio, true, true);
+
+  while (!gpio_read(sensor_gpio) && rise < SENSOR_PROBE_MAX_RISE) {
+    rise++;
+  }
+  taskEXIT_CRITICAL();
+
+  return rise < SENSOR_PROBE_MAX_RISE ? rise : -1;
+}
+
+// Returns true when the sensor's health changed
+static bool sensor_probe(uint8_t sensor_gpio) {
+  // Only an open switch is ambiguous
+  if (gpio_read(sensor_gpio) == SENSOR_CLOSED) {
+    return sensor_record_probe(sensor_gpio, PROBE_CONNECTED);
+  }
+
+  int rise = sensor_probe_rise(sensor_gpio);
+
+  // Every rise is logged until calibrated, the minimum is picked from these
+  if (!probe_enabled()) {
+    printf("%s(%d) sensor probe rise %d\n", sensor_description(sensor_gpio),
+           sensor_gpio, rise);
+    return false;
+  }
+
+  probe_result_t result = probe_classify(rise);
+
+  if (result == PROBE_DISCONNECTED) {
+    printf("%s(%d) sensor probe rise %d below minimum of %d\n",
+           sensor_description(sensor_gpio), sensor_gpio, rise,
+           SENSOR_PROBE_MIN_RISE);
+  }
+
+  return sensor_record_probe(sensor_gpio, result);
+}
+
+static void door_handle_probe_timer() {
+  uint32_t started = budget_start();
+
+  if (probe_due(started, g_last_sensor_change)) {
+    bool bottom_changed = sensor_probe(g_bottom_sensor_gpio);
+    bool top_changed = sensor_probe(g_top_sensor_gpio);
+
+    if (bottom_changed || top_changed) {
+      door_state_t door_state = door_current_state();
+
+      printf("Door appears to be %s\n", door_state_description(door_state));
+
+      g_on_door_fault_changed(door_faulted());
+      g_on_door_state_changed(door_state);
+    }
+  }
+
+  budget_stop(&g_sensor_probe_budget, started);
 }
 
 static void sensor_init(uint8_t *p_sensor_gpio) {
@@ -91,25 +220,55 @@ static void sensor_init(uint8_t *p_sensor_gpio) {
 }
 
 void door_init(uint8_t bottom_sensor_gpio, uint8_t top_sensor_gpio,
-               door_callback_fn on_door_state_changed) {
+               door_callback_fn on_door_state_changed,
+               door_fault_fn on_door_fault_changed) {
   // These should not be set prior to init and init should fail if run more than
   // once
   assert(g_bottom_sensor_gpio == 0 && g_top_sensor_gpio == 0 &&
-         g_on_door_state_changed == 0);
+         g_on_door_state_changed == 0 && g_on_door_fault_changed == 0);
 
   g_bottom_sensor_gpio = bottom_sensor_gpio;
   g_top_sensor_gpio = top_sensor_gpio;
   g_on_door_state_changed = on_door_state_changed;
+  g_on_door_fault_changed = on_door_fault_changed;
 
   sensor_init(&g_bottom_sensor_gpio);
   sensor_init(&g_top_sensor_gpio);
 
   reset_sensor_state();
+
+  if (!probe_enabled()) {
+    printf("Sensor probe only logs rise, SENSOR_PROBE_MIN_RISE is not set\n");
+  }
+
+  sdk_os_timer_disarm(&g_probe_timer);
+  sdk_os_timer_setfn(&g_probe_timer, door_handle_probe_timer, NULL);
+  sdk_os_timer_arm(&g_probe_timer, SENSOR_PROBE_INTERVAL, true);
 }
 
 door_state_t door_current_state() {
   const door_state_t g_sensor_state_matrix[][2] = {{DOOR_UNKNOWN, DOOR_CLOSED},
                                                    {DOOR_OPEN, DOOR_MOVING}};
 
-  return g_sensor_state_matrix[g_bottom_sensor_state][g_top_sensor_state];
+  door_state_t door_state =
+      g_sensor_state_matrix[g_bottom_sensor_state][g_top_sensor_state];
+
+  // A disconnected sensor always reads open, so the door can only be trusted
+  // when the other sensor is closed
+  if (door_state == DOOR_MOVING && door_faulted()) {
+    door_state = DOOR_UNKNOWN;
+  }
+
+  return door_state;
+}
+
+bool door_sensor_disconnected(uint8_t sensor_gpio) {
+  probe_health_t *health = sensor_health(sensor_gpio);
+
+  return health != NULL && health->disconnected;
+}
+
+bool door_faulted() {
+  return g_bottom_sensor_health.disconnected ||
+         g_top_sensor_health.disconnected;
 }
@@ -11,9 +11,12 @@ typedef enum {
 } door_state_t;
 
 typedef void (*door_callback_fn)(door_state_t new_state);
+typedef void (*door_fault_fn)(bool faulted);
 
 void door_init(uint8_t p_bottom_sensor_gpio, uint8_t p_top_sensor_gpio,
-               door_callback_fn g_callback);
+               door_callback_fn g_callback, door_fault_fn g_fault_callback);
 door_state_t door_current_state();
+bool door_sensor_disconnected(uint8_t sensor_gpio);
+bool door_faulted();
 
 #endif /* DOOR_H */
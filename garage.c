@@ -1,5 +1,6 @@
 #include <FreeRTOS.h>
 #include <esp/uart.h>
+#include <espressif/esp_system.h>
 #include <stdio.h>
 #include <wifi_config.h>
 
@@ -7,6 +8,7 @@
 #include "door.h"
 #include "machine.h"
 #include "timed_latch.h"
+#include "transitions.h"
 
 #define RELAY_HOLD_DURATION 100
 
@@ -32,8 +34,19 @@ static void handle_door_state_changed(door_state_t new_state) {
   machine_handle_event(door_state_map[new_state]);
 }
 
-static void handle_wifi_ready() {
-  door_init(BOTTOM_PIN, TOP_PIN, handle_door_state_changed);
+static void handle_door_fault_changed(bool faulted) {
+  accessory_notify_fault(faulted);
+}
+
+static void handle_wifi_ready() { accessory_start(); }
+
+// The machine is brought up before WiFi so a door that was mid-travel when the
+// device reset keeps being tracked
+static void restore_state() {
+  uint32_t started = sdk_system_get_time();
+
+  door_init(BOTTOM_PIN, TOP_PIN, handle_door_state_changed,
+            handle_door_fault_changed);
   timed_latch_init(RELAY_PIN, RELAY_HOLD_DURATION);
 
   const machine_state_t initial_state_map[] = {
@@ -44,6 +57,14 @@ static void handle_wifi_ready() {
   };
 
   accessory_init(&g_accessory_config, initial_state_map[door_current_state()]);
+
+  // The machine reconciles a state restored from before a reset with where the
+  // sensors say the door is now, this is a no-op for a state read from them
+  handle_door_state_changed(door_current_state());
+
+  printf("Started with door state '%s' in %uus\n",
+         machine_state_description(machine_current_state()),
+         sdk_system_get_time() - started);
 }
 
 void user_init(void) {
@@ -51,5 +72,7 @@ void user_init(void) {
 
   printf("Staring Garage Door Opener...");
 
+  restore_state();
+
   wifi_config_init("garage-door", NULL, handle_wifi_ready);
 }
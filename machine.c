@@ -32,6 +32,8 @@ void machine_handle_event(machine_event_t event) {
 
   if (transitioner != NULL) {
     g_current_state = transitioner(g_current_state, event);
+    // Transitions arm and disarm timers even when the state does not change
+    transition_retain(g_current_state);
 
     if (g_current_state == prev_state) {
       printf("Machine received event %s while %s\n",
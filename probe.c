@@ -0,0 +1,37 @@
+#include "probe.h"
+
+bool probe_enabled() { return SENSOR_PROBE_MIN_RISE > 0; }
+
+// Times are microseconds, unsigned subtraction handles the counter wrapping
+bool probe_due(uint32_t now, uint32_t last_sensor_change) {
+  return now - last_sensor_change >= SENSOR_PROBE_QUIET_PERIOD * 1000;
+}
+
+// A negative rise means the line never came back up, ie. the switch closed
+// while it was being probed
+probe_result_t probe_classify(int rise) {
+  if (rise < 0) {
+    return PROBE_INCONCLUSIVE;
+  }
+
+  return rise < SENSOR_PROBE_MIN_RISE ? PROBE_DISCONNECTED : PROBE_CONNECTED;
+}
+
+// Returns true when the sensor's health changed
+bool probe_record(probe_health_t *health, probe_result_t result) {
+  if (result == PROBE_INCONCLUSIVE) {
+    return false;
+  }
+
+  if (result == PROBE_CONNECTED) {
+    health->failed_probes = 0;
+  } else if (health->failed_probes < SENSOR_PROBE_FAILURE_THRESHOLD) {
+    health->failed_probes++;
+  }
+
+  bool was_disconnected = health->disconnected;
+  health->disconnected =
+      health->failed_probes >= SENSOR_PROBE_FAILURE_THRESHOLD;
+
+  return health->disconnected != was_disconnected;
+}
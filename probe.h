@@ -0,0 +1,47 @@
+#ifndef PROBE_H
+#define PROBE_H
+
+#include <FreeRTOS.h>
+
+// Sensor integrity probe. An open reed switch and a cut wire both leave the
+// input floating high, so sensors are told apart by the capacitance of the
+// cable attached to them: the line is discharged and the number of polls it
+// takes the pull-up to bring it back high is counted.
+//
+// Detection limits:
+// - Only a cable cut at or near the board connector is detected. A cut at the
+//   sensor end leaves the cable's capacitance on the pin and reads exactly like
+//   an open switch.
+// - The minimum rise depends on cable length and the board, so it has to be
+//   calibrated per install. Until SENSOR_PROBE_MIN_RISE is set the probe only
+//   logs every rise it measures and never affects door state, pick a minimum
+//   well below the rise logged for each connected sensor.
+// - Closed sensors are never probed, a closed switch proves the wiring.
+#ifndef SENSOR_PROBE_MIN_RISE
+#define SENSOR_PROBE_MIN_RISE 0
+#endif
+#define SENSOR_PROBE_MAX_RISE 2000
+#define SENSOR_PROBE_DISCHARGE 5
+#define SENSOR_PROBE_INTERVAL 2000
+// Probes are skipped for this long after an edge so they never overlap real
+// door movement
+#define SENSOR_PROBE_QUIET_PERIOD 1000
+#define SENSOR_PROBE_FAILURE_THRESHOLD 3
+
+typedef enum {
+  PROBE_CONNECTED = 0,
+  PROBE_DISCONNECTED,
+  PROBE_INCONCLUSIVE,
+} probe_result_t;
+
+typedef struct probe_health_t {
+  uint8_t failed_probes;
+  bool disconnected;
+} probe_health_t;
+
+bool probe_enabled();
+bool probe_due(uint32_t now, uint32_t last_sensor_change);
+probe_result_t probe_classify(int rise);
+bool probe_record(probe_health_t *health, probe_result_t result);
+
+#endif /* PROBE_H */
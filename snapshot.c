@@ -0,0 +1,122 @@
+#include "snapshot.h"
+
+#include <espressif/esp_system.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// RTC user memory starts at block 64, blocks are 4 bytes wide. RTC memory and
+// the RTC counter survive everything but a power-on reset.
+#define SNAPSHOT_RTC_BLOCK 64
+#define SNAPSHOT_MAGIC 0x47415244
+
+typedef struct snapshot_record_t {
+  uint32_t magic;
+  uint32_t rtc_time;
+  uint32_t rtc_period;
+  uint32_t movement_remaining;
+  uint32_t reverse_remaining;
+  uint8_t state;
+  uint8_t reverse_state;
+  uint16_t reserved;
+  uint32_t checksum;
+} snapshot_record_t;
+
+// FNV-1a over everything but the trailing checksum
+static uint32_t snapshot_checksum(const snapshot_record_t *record) {
+  const uint8_t *data = (const uint8_t *)record;
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < offsetof(snapshot_record_t, checksum); i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+
+  return hash;
+}
+
+// RTC period is a Q12 fixed point number of microseconds per RTC cycle
+static uint32_t snapshot_elapsed(const snapshot_record_t *record) {
+  uint32_t cycles = sdk_system_get_rtc_time() - record->rtc_time;
+  uint64_t elapsed = (((uint64_t)cycles * record->rtc_period) >> 12) / 1000;
+
+  return elapsed < UINT32_MAX ? elapsed : UINT32_MAX;
+}
+
+// Only resets the firmware caused itself are resumed. After an external reset
+// or a wake from deep sleep the device may have been off for any length of
+// time.
+static bool snapshot_reset_resumable() {
+  switch (sdk_system_get_rst_info()->reason) {
+  case WDT_RST:
+  case EXCEPTION_RST:
+  case SOFT_WDT_RST:
+  case SOFT_RESTART:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static uint32_t snapshot_remaining(uint32_t remaining, uint32_t elapsed) {
+  if (remaining == 0) {
+    return 0;
+  }
+
+  // An expired timer still needs to fire so its transition is not lost
+  return remaining > elapsed ? remaining - elapsed : 1;
+}
+
+void snapshot_save(const snapshot_t *snapshot) {
+  snapshot_record_t record = {
+      .magic = SNAPSHOT_MAGIC,
+      .rtc_time = sdk_system_get_rtc_time(),
+      .rtc_period = sdk_system_rtc_clock_cali_proc(),
+      .movement_remaining = snapshot->movement_remaining,
+      .reverse_remaining = snapshot->reverse_remaining,
+      .state = snapshot->state,
+      .reverse_state = snapshot->reverse_state,
+  };
+  record.checksum = snapshot_checksum(&record);
+
+  if (!sdk_system_rtc_mem_write(SNAPSHOT_RTC_BLOCK, &record, sizeof(record))) {
+    printf("Failed to write state snapshot\n");
+  }
+}
+
+bool snapshot_restore(snapshot_t *snapshot) {
+  snapshot_record_t record;
+
+  if (!snapshot_reset_resumable()) {
+    printf("Not restoring state snapshot after reset reason %u\n",
+           sdk_system_get_rst_info()->reason);
+    return false;
+  }
+
+  if (!sdk_system_rtc_mem_read(SNAPSHOT_RTC_BLOCK, &record, sizeof(record)) ||
+      record.magic != SNAPSHOT_MAGIC ||
+      record.checksum != snapshot_checksum(&record)) {
+    printf("No valid state snapshot\n");
+    return false;
+  }
+
+  uint32_t elapsed = snapshot_elapsed(&record);
+
+  if (elapsed > SNAPSHOT_MAX_AGE ||
+      (record.movement_remaining != 0 &&
+       elapsed > record.movement_remaining + SNAPSHOT_GRACE_PERIOD) ||
+      (record.reverse_remaining != 0 &&
+       elapsed > record.reverse_remaining + SNAPSHOT_GRACE_PERIOD)) {
+    printf("State snapshot is stale, saved %ums ago\n", elapsed);
+    return false;
+  }
+
+  snapshot->state = record.state;
+  snapshot->reverse_state = record.reverse_state;
+  snapshot->movement_remaining =
+      snapshot_remaining(record.movement_remaining, elapsed);
+  snapshot->reverse_remaining =
+      snapshot_remaining(record.reverse_remaining, elapsed);
+
+  printf("Restored state snapshot saved %ums ago\n", elapsed);
+
+  return true;
+}
@@ -0,0 +1,27 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <FreeRTOS.h>
+
+#include "machine.state.h"
+
+// The door may have been moved by hand any time the firmware was not watching
+// it, so only a recent snapshot is trusted. This covers the longest movement
+// timeout with room to spare.
+#define SNAPSHOT_MAX_AGE 60000
+// A snapshot whose timers expired longer ago than this is too stale to resume,
+// reversing the door that late could surprise whoever is standing near it
+#define SNAPSHOT_GRACE_PERIOD 2000
+
+// Timer values are milliseconds until the timer fires, 0 when disarmed
+typedef struct snapshot_t {
+  machine_state_t state;
+  machine_state_t reverse_state;
+  uint32_t movement_remaining;
+  uint32_t reverse_remaining;
+} snapshot_t;
+
+void snapshot_save(const snapshot_t *snapshot);
+bool snapshot_restore(snapshot_t *snapshot);
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,234 @@
+#include "fake.h"
+
+#include <espressif/esp_misc.h>
+#include <espressif/esp_system.h>
+#include <string.h>
+#include <task.h>
+#include <toggle.h>
+
+// Q12 calibration of exactly 5us per RTC cycle
+#define FAKE_RTC_PERIOD (5 << 12)
+
+typedef struct fake_gpio_t {
+  gpio_direction_t direction;
+  bool output;
+  bool closed;
+  int rise;
+  int low_reads;
+  uint32_t falls;
+  toggle_callback_fn toggle;
+  void *toggle_context;
+} fake_gpio_t;
+
+static fake_rtc_t g_fake_rtc;
+fake_rtc_t *gp_fake_rtc = &g_fake_rtc;
+
+#define FAKE_TIMER_COUNT 16
+
+static uint32_t g_now;
+static ETSTimer *gp_timers[FAKE_TIMER_COUNT];
+static fake_gpio_t g_gpios[FAKE_GPIO_COUNT];
+static struct sdk_rst_info g_rst_info;
+
+void fake_reboot() {
+  g_now = 0;
+  memset(gp_timers, 0, sizeof(gp_timers));
+  memset(g_gpios, 0, sizeof(g_gpios));
+}
+
+void fake_reset() {
+  fake_reboot();
+  memset(gp_fake_rtc, 0, sizeof(*gp_fake_rtc));
+}
+
+static void fake_set_now(uint32_t now) {
+  gp_fake_rtc->cycles += (now - g_now) / 5;
+  g_now = now;
+}
+
+static ETSTimer *fake_next_timer(uint32_t until) {
+  ETSTimer *next = NULL;
+
+  for (int i = 0; i < FAKE_TIMER_COUNT; i++) {
+    ETSTimer *timer = gp_timers[i];
+    if (timer != NULL && timer->armed && timer->deadline <= until &&
+        (next == NULL || timer->deadline < next->deadline)) {
+      next = timer;
+    }
+  }
+
+  return next;
+}
+
+void fake_advance(uint32_t ms) { fake_advance_us(ms * 1000); }
+
+void fake_advance_us(uint32_t us) {
+  uint32_t until = g_now + us;
+  ETSTimer *timer;
+
+  while ((timer = fake_next_timer(until)) != NULL) {
+    fake_set_now(timer->deadline);
+    if (timer->repeat) {
+      timer->deadline += timer->period * 1000;
+    } else {
+      timer->armed = false;
+    }
+    timer->fn(timer->arg);
+  }
+
+  fake_set_now(until);
+}
+
+uint32_t fake_now() { return g_now; }
+
+bool fake_timer_armed(uint32_t period) {
+  for (int i = 0; i < FAKE_TIMER_COUNT; i++) {
+    if (gp_timers[i] != NULL && gp_timers[i]->armed &&
+        gp_timers[i]->period == period) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+int fake_timer_remaining(uint32_t *remaining, int max) {
+  int count = 0;
+
+  for (int i = 0; i < FAKE_TIMER_COUNT && count < max; i++) {
+    ETSTimer *timer = gp_timers[i];
+    if (timer == NULL || !timer->armed || timer->repeat) {
+      continue;
+    }
+
+    uint32_t left = (timer->deadline - g_now) / 1000;
+    int j = count++;
+    for (; j > 0 && remaining[j - 1] > left; j--) {
+      remaining[j] = remaining[j - 1];
+    }
+    remaining[j] = left;
+  }
+
+  return count;
+}
+
+void fake_gpio_set_closed(uint8_t gpio, bool closed) {
+  g_gpios[gpio].closed = closed;
+}
+
+void fake_gpio_set_rise(uint8_t gpio, int rise) { g_gpios[gpio].rise = rise; }
+
+void fake_toggle(uint8_t gpio, bool closed) {
+  fake_gpio_t *fake = &g_gpios[gpio];
+
+  fake->closed = closed;
+  fake->toggle(!closed, fake->toggle_context);
+}
+
+uint32_t fake_gpio_falls(uint8_t gpio) { return g_gpios[gpio].falls; }
+
+uint32_t sdk_system_get_time(void) { return g_now; }
+
+uint32_t sdk_system_get_rtc_time(void) { return gp_fake_rtc->cycles; }
+
+uint32_t sdk_system_rtc_clock_cali_proc(void) { return FAKE_RTC_PERIOD; }
+
+bool sdk_system_rtc_mem_read(uint8_t src_addr, void *dst, uint16_t save_size) {
+  if (src_addr < 64 || src_addr * 4 + save_size > sizeof(gp_fake_rtc->memory)) {
+    return false;
+  }
+
+  memcpy(dst, &gp_fake_rtc->memory[src_addr], save_size);
+  return true;
+}
+
+bool sdk_system_rtc_mem_write(uint8_t dst_addr, const void *src,
+                              uint16_t save_size) {
+  if (dst_addr < 64 || dst_addr * 4 + save_size > sizeof(gp_fake_rtc->memory)) {
+    return false;
+  }
+
+  memcpy(&gp_fake_rtc->memory[dst_addr], src, save_size);
+  return true;
+}
+
+struct sdk_rst_info *sdk_system_get_rst_info(void) {
+  g_rst_info.reason = gp_fake_rtc->reset_reason;
+  return &g_rst_info;
+}
+
+void sdk_os_delay_us(uint16_t us) {}
+
+void sdk_os_timer_setfn(ETSTimer *timer, ETSTimerFunc fn, void *arg) {
+  timer->fn = fn;
+  timer->arg = arg;
+
+  for (int i = 0; i < FAKE_TIMER_COUNT; i++) {
+    if (gp_timers[i] == timer) {
+      return;
+    }
+  }
+  for (int i = 0; i < FAKE_TIMER_COUNT; i++) {
+    if (gp_timers[i] == NULL) {
+      gp_timers[i] = timer;
+      return;
+    }
+  }
+}
+
+void sdk_os_timer_arm(ETSTimer *timer, uint32_t period, bool repeat) {
+  timer->period = period;
+  timer->repeat = repeat;
+  timer->deadline = g_now + period * 1000;
+  timer->armed = true;
+}
+
+void sdk_os_timer_disarm(ETSTimer *timer) { timer->armed = false; }
+
+void vTaskDelay(TickType_t ticks) {}
+
+void gpio_enable(uint8_t gpio, gpio_direction_t direction) {
+  fake_gpio_t *fake = &g_gpios[gpio];
+
+  // Releasing a discharged line leaves it low until the pull-up charges it
+  if (fake->direction == GPIO_OUTPUT && direction == GPIO_INPUT &&
+      !fake->output) {
+    fake->low_reads = fake->rise;
+  }
+  fake->direction = direction;
+}
+
+void gpio_write(uint8_t gpio, bool set) {
+  if (g_gpios[gpio].output && !set) {
+    g_gpios[gpio].falls++;
+  }
+  g_gpios[gpio].output = set;
+}
+
+bool gpio_read(uint8_t gpio) {
+  fake_gpio_t *fake = &g_gpios[gpio];
+
+  if (fake->direction == GPIO_OUTPUT) {
+    return fake->output;
+  }
+
+  if (fake->closed) {
+    return false;
+  }
+
+  if (fake->low_reads > 0) {
+    fake->low_reads--;
+    return false;
+  }
+
+  return true;
+}
+
+void gpio_set_pullup(uint8_t gpio, bool enabled, bool enabled_during_sleep) {}
+
+int toggle_create(uint8_t gpio_num, toggle_callback_fn callback,
+                  void *context) {
+  g_gpios[gpio_num].toggle = callback;
+  g_gpios[gpio_num].toggle_context = context;
+  return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef FAKE_H
+#define FAKE_H
+
+#include <FreeRTOS.h>
+#include <etstimer.h>
+
+// Host fakes for the SDK calls made by the firmware. Time only moves when a
+// test advances it, armed timers fire in deadline order as it does.
+
+#define FAKE_GPIO_COUNT 17
+#define FAKE_RTC_BLOCKS 192
+
+typedef struct fake_rtc_t {
+  uint32_t memory[FAKE_RTC_BLOCKS];
+  uint32_t cycles;
+  uint32_t reset_reason;
+} fake_rtc_t;
+
+// RTC state outlives a simulated reset, tests that reset by forking point this
+// at shared memory
+extern fake_rtc_t *gp_fake_rtc;
+
+// Clears everything but RTC state, as a reset does
+void fake_reboot();
+void fake_reset();
+// Advances time in milliseconds, firing timers that fall due on the way
+void fake_advance(uint32_t ms);
+void fake_advance_us(uint32_t us);
+uint32_t fake_now();
+
+// Whether a timer with the given period, in milliseconds, is armed
+bool fake_timer_armed(uint32_t period);
+// Fills remaining with the milliseconds left on each armed one-shot timer,
+// shortest first, and returns how many there are
+int fake_timer_remaining(uint32_t *remaining, int max);
+
+// A closed switch pulls the line low. Otherwise the line reads low for `rise`
+// reads after being discharged, modelling the cable's capacitance.
+void fake_gpio_set_closed(uint8_t gpio, bool closed);
+void fake_gpio_set_rise(uint8_t gpio, int rise);
+void fake_toggle(uint8_t gpio, bool closed);
+// Number of high to low writes, eg. relay pulses on an active low relay
+uint32_t fake_gpio_falls(uint8_t gpio);
+
+#endif /* FAKE_H */
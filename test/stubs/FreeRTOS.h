@@ -0,0 +1,22 @@
+// Host stand-in for the FreeRTOS headers used by the firmware
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <esp/gpio.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffff
+#define portTICK_PERIOD_MS 10
+#define pdMS_TO_TICKS(ms) ((ms) / portTICK_PERIOD_MS)
+
+#endif /* FREERTOS_H */
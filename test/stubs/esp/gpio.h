@@ -0,0 +1,17 @@
+#ifndef ESP_GPIO_H
+#define ESP_GPIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+  GPIO_INPUT,
+  GPIO_OUTPUT,
+} gpio_direction_t;
+
+void gpio_enable(uint8_t gpio, gpio_direction_t direction);
+void gpio_write(uint8_t gpio, bool set);
+bool gpio_read(uint8_t gpio);
+void gpio_set_pullup(uint8_t gpio, bool enabled, bool enabled_during_sleep);
+
+#endif /* ESP_GPIO_H */
@@ -0,0 +1,3 @@
+#ifndef ESPLIBS_LIBMAIN_H
+#define ESPLIBS_LIBMAIN_H
+#endif /* ESPLIBS_LIBMAIN_H */
@@ -0,0 +1,8 @@
+#ifndef ESPRESSIF_ESP_MISC_H
+#define ESPRESSIF_ESP_MISC_H
+
+#include <stdint.h>
+
+void sdk_os_delay_us(uint16_t us);
+
+#endif /* ESPRESSIF_ESP_MISC_H */
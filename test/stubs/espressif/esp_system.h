@@ -0,0 +1,35 @@
+#ifndef ESPRESSIF_ESP_SYSTEM_H
+#define ESPRESSIF_ESP_SYSTEM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum sdk_rst_reason {
+  DEFAULT_RST = 0,
+  WDT_RST = 1,
+  EXCEPTION_RST = 2,
+  SOFT_WDT_RST = 3,
+  SOFT_RESTART = 4,
+  DEEP_SLEEP_AWAKE = 5,
+  EXT_RST = 6,
+};
+
+struct sdk_rst_info {
+  uint32_t reason;
+  uint32_t exccause;
+  uint32_t epc1;
+  uint32_t epc2;
+  uint32_t epc3;
+  uint32_t excvaddr;
+  uint32_t depc;
+};
+
+uint32_t sdk_system_get_time(void);
+uint32_t sdk_system_get_rtc_time(void);
+uint32_t sdk_system_rtc_clock_cali_proc(void);
+bool sdk_system_rtc_mem_read(uint8_t src_addr, void *dst, uint16_t save_size);
+bool sdk_system_rtc_mem_write(uint8_t dst_addr, const void *src,
+                              uint16_t save_size);
+struct sdk_rst_info *sdk_system_get_rst_info(void);
+
+#endif /* ESPRESSIF_ESP_SYSTEM_H */
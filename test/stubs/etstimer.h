@@ -0,0 +1,23 @@
+#ifndef ETSTIMER_H
+#define ETSTIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef void (*ETSTimerFunc)(void *arg);
+
+// Fake timers fire as tests advance fake time, see fake.h
+typedef struct ETSTimer {
+  ETSTimerFunc fn;
+  void *arg;
+  uint32_t period;
+  uint32_t deadline;
+  bool repeat;
+  bool armed;
+} ETSTimer;
+
+void sdk_os_timer_setfn(ETSTimer *timer, ETSTimerFunc fn, void *arg);
+void sdk_os_timer_arm(ETSTimer *timer, uint32_t period, bool repeat);
+void sdk_os_timer_disarm(ETSTimer *timer);
+
+#endif /* ETSTIMER_H */
@@ -0,0 +1,15 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <FreeRTOS.h>
+
+typedef void *TaskHandle_t;
+
+#define tskIDLE_PRIORITY 0
+// Tests are single threaded
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+void vTaskDelay(TickType_t ticks);
+
+#endif /* TASK_H */
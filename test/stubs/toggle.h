@@ -0,0 +1,10 @@
+#ifndef TOGGLE_H
+#define TOGGLE_H
+
+#include <FreeRTOS.h>
+
+typedef void (*toggle_callback_fn)(bool high, void *context);
+
+int toggle_create(uint8_t gpio_num, toggle_callback_fn callback, void *context);
+
+#endif /* TOGGLE_H */
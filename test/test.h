@@ -0,0 +1,44 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fake.h"
+
+// Each test runs in its own process so firmware modules start from zeroed
+// statics and a failed assert fails only that test. Firmware logging is hidden
+// unless VERBOSE is set.
+static int g_test_failures;
+
+static void test_run(const char *name, void (*test)()) {
+  fflush(stdout);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (getenv("VERBOSE") == NULL) {
+      freopen("/dev/null", "w", stdout);
+    }
+    fake_reset();
+    test();
+    exit(0);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+
+  bool passed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  if (!passed) {
+    g_test_failures++;
+  }
+
+  printf("%s - %s\n", passed ? "ok" : "FAIL", name);
+}
+
+#define RUN_TEST(test) test_run(#test, test)
+#define TEST_RESULT() (g_test_failures == 0 ? 0 : 1)
+
+#endif /* TEST_H */
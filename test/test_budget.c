@@ -0,0 +1,64 @@
+#include <assert.h>
+
+#include "../budget.h"
+#include "test.h"
+
+static budget_site_t g_site = BUDGET_SITE("test");
+
+static void budget_time(uint32_t duration) {
+  uint32_t started = budget_start();
+  fake_advance_us(duration);
+  budget_stop(&g_site, started);
+}
+
+static void test_budget_registers_on_first_stop() {
+  assert(!g_site.registered);
+
+  budget_time(10);
+  assert(g_site.registered);
+  assert(g_site.calls == 1);
+
+  budget_time(10);
+  assert(g_site.calls == 2);
+  // Registering twice would link the site to itself
+  assert(g_site.next == NULL);
+}
+
+static void test_budget_tracks_worst() {
+  budget_time(300);
+  budget_time(100);
+  assert(g_site.worst == 300);
+
+  budget_time(500);
+  assert(g_site.worst == 500);
+}
+
+static void test_budget_counts_violations_over_budget() {
+  budget_time(CALLBACK_BUDGET);
+  assert(g_site.violations == 0);
+
+  budget_time(CALLBACK_BUDGET + 1);
+  assert(g_site.violations == 1);
+  assert(g_site.worst == CALLBACK_BUDGET + 1);
+}
+
+static void test_budget_handles_time_wrap() {
+  fake_advance_us(UINT32_MAX - fake_now() - 100);
+
+  budget_time(200);
+  assert(g_site.worst == 200);
+  assert(g_site.violations == 0);
+
+  fake_advance_us(UINT32_MAX - fake_now() - 100);
+  budget_time(CALLBACK_BUDGET + 1);
+  assert(g_site.violations == 1);
+}
+
+int main() {
+  RUN_TEST(test_budget_registers_on_first_stop);
+  RUN_TEST(test_budget_tracks_worst);
+  RUN_TEST(test_budget_counts_violations_over_budget);
+  RUN_TEST(test_budget_handles_time_wrap);
+
+  return TEST_RESULT();
+}
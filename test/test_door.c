@@ -0,0 +1,190 @@
+#include <assert.h>
+#include <string.h>
+
+#include "../door.h"
+#include "../probe.h"
+#include "test.h"
+
+#define BOTTOM 12
+#define TOP 13
+// Polls taken to charge a sensor cable and a bare pin
+#define CABLE_RISE 200
+#define BARE_RISE 2
+
+static door_state_t g_door_state = DOOR_UNKNOWN;
+static int g_door_state_changes;
+static bool g_faulted;
+static int g_fault_changes;
+
+static void on_door_state_changed(door_state_t new_state) {
+  g_door_state = new_state;
+  g_door_state_changes++;
+}
+
+static void on_door_fault_changed(bool faulted) {
+  g_faulted = faulted;
+  g_fault_changes++;
+}
+
+static void door_start(bool bottom_closed, bool top_closed) {
+  fake_gpio_set_closed(BOTTOM, bottom_closed);
+  fake_gpio_set_closed(TOP, top_closed);
+  fake_gpio_set_rise(BOTTOM, CABLE_RISE);
+  fake_gpio_set_rise(TOP, CABLE_RISE);
+
+  door_init(BOTTOM, TOP, on_door_state_changed, on_door_fault_changed);
+}
+
+static void probe_times(int probes) {
+  fake_advance(probes * SENSOR_PROBE_INTERVAL);
+}
+
+static void test_door_probe_is_scheduled() {
+  door_start(true, false);
+
+  assert(fake_timer_armed(SENSOR_PROBE_INTERVAL));
+}
+
+#if SENSOR_PROBE_MIN_RISE == 0
+// Sends firmware logging to a temporary file until log_read
+static FILE *log_capture() {
+  FILE *log = tmpfile();
+  assert(log);
+
+  fflush(stdout);
+  dup2(fileno(log), STDOUT_FILENO);
+  return log;
+}
+
+static void log_read(FILE *log, char *buffer, size_t size) {
+  fflush(stdout);
+  rewind(log);
+  size_t length = fread(buffer, 1, size - 1, log);
+  buffer[length] = '\0';
+}
+
+static void test_door_uncalibrated_probe_logs_every_rise() {
+  door_start(false, false);
+  fake_gpio_set_rise(TOP, BARE_RISE);
+  FILE *log = log_capture();
+
+  probe_times(2);
+
+  char buffer[512];
+  log_read(log, buffer, sizeof(buffer));
+
+  // Both probes of both sensors
+  char *bottom = strstr(buffer, "bottom(12) sensor probe rise 200\n");
+  assert(bottom && strstr(bottom + 1, "bottom(12) sensor probe rise 200\n"));
+  char *top = strstr(buffer, "top(13) sensor probe rise 2\n");
+  assert(top && strstr(top + 1, "top(13) sensor probe rise 2\n"));
+}
+
+static void test_door_uncalibrated_probe_never_faults() {
+  door_start(false, false);
+  fake_gpio_set_rise(BOTTOM, BARE_RISE);
+  fake_gpio_set_rise(TOP, BARE_RISE);
+
+  probe_times(SENSOR_PROBE_FAILURE_THRESHOLD * 3);
+  fake_toggle(TOP, true);
+  fake_toggle(TOP, false);
+  probe_times(SENSOR_PROBE_FAILURE_THRESHOLD * 3);
+
+  assert(!door_faulted());
+  assert(!door_sensor_disconnected(BOTTOM) && !door_sensor_disconnected(TOP));
+  assert(g_fault_changes == 0);
+  // Only the two edges changed the door state
+  assert(g_door_state_changes == 2);
+  assert(door_current_state() == DOOR_MOVING);
+}
+#else
+
+static void test_door_connected_sensors_stay_healthy() {
+  door_start(true, false);
+
+  probe_times(10);
+
+  assert(g_fault_changes == 0);
+  assert(!door_faulted());
+  assert(door_current_state() == DOOR_CLOSED);
+}
+
+static void test_door_detects_cut_wire_within_seconds() {
+  door_start(true, false);
+  fake_gpio_set_rise(TOP, BARE_RISE);
+
+  probe_times(SENSOR_PROBE_FAILURE_THRESHOLD - 1);
+  assert(!door_faulted());
+
+  probe_times(1);
+  assert(door_faulted());
+  assert(door_sensor_disconnected(TOP));
+  assert(!door_sensor_disconnected(BOTTOM));
+  assert(g_faulted && g_fault_changes == 1);
+  // The closed bottom sensor still pins the door down
+  assert(door_current_state() == DOOR_CLOSED);
+}
+
+static void test_door_cut_wire_is_not_reported_as_moving() {
+  door_start(false, false);
+  assert(door_current_state() == DOOR_MOVING);
+  fake_gpio_set_rise(BOTTOM, BARE_RISE);
+
+  probe_times(SENSOR_PROBE_FAILURE_THRESHOLD);
+
+  assert(door_current_state() == DOOR_UNKNOWN);
+  assert(g_door_state == DOOR_UNKNOWN);
+}
+
+static void test_door_probe_leaves_line_high() {
+  door_start(true, false);
+
+  probe_times(1);
+
+  assert(gpio_read(TOP));
+}
+
+static void test_door_probe_skips_quiet_period() {
+  door_start(true, false);
+  fake_gpio_set_rise(TOP, BARE_RISE);
+
+  // An edge before every probe keeps the probe from ever running
+  for (int i = 0; i < SENSOR_PROBE_FAILURE_THRESHOLD * 2; i++) {
+    fake_advance(SENSOR_PROBE_INTERVAL - SENSOR_PROBE_QUIET_PERIOD / 2);
+    fake_toggle(BOTTOM, i % 2);
+    fake_advance(SENSOR_PROBE_QUIET_PERIOD / 2);
+  }
+
+  assert(!door_faulted());
+}
+
+static void test_door_closing_sensor_clears_fault() {
+  door_start(true, false);
+  fake_gpio_set_rise(TOP, BARE_RISE);
+  probe_times(SENSOR_PROBE_FAILURE_THRESHOLD);
+  assert(door_faulted());
+
+  fake_toggle(TOP, true);
+
+  assert(!door_faulted());
+  assert(!g_faulted && g_fault_changes == 2);
+}
+
+#endif
+
+int main() {
+  RUN_TEST(test_door_probe_is_scheduled);
+#if SENSOR_PROBE_MIN_RISE == 0
+  RUN_TEST(test_door_uncalibrated_probe_logs_every_rise);
+  RUN_TEST(test_door_uncalibrated_probe_never_faults);
+#else
+  RUN_TEST(test_door_connected_sensors_stay_healthy);
+  RUN_TEST(test_door_detects_cut_wire_within_seconds);
+  RUN_TEST(test_door_cut_wire_is_not_reported_as_moving);
+  RUN_TEST(test_door_probe_leaves_line_high);
+  RUN_TEST(test_door_probe_skips_quiet_period);
+  RUN_TEST(test_door_closing_sensor_clears_fault);
+#endif
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,74 @@
+#include <assert.h>
+
+#include "../probe.h"
+#include "test.h"
+
+static void test_probe_enabled_once_calibrated() { assert(probe_enabled()); }
+
+static void test_probe_classifies_rise() {
+  assert(probe_classify(-1) == PROBE_INCONCLUSIVE);
+  assert(probe_classify(0) == PROBE_DISCONNECTED);
+  assert(probe_classify(SENSOR_PROBE_MIN_RISE - 1) == PROBE_DISCONNECTED);
+  assert(probe_classify(SENSOR_PROBE_MIN_RISE) == PROBE_CONNECTED);
+  assert(probe_classify(SENSOR_PROBE_MAX_RISE - 1) == PROBE_CONNECTED);
+}
+
+static void test_probe_waits_for_quiet_period() {
+  const uint32_t quiet = SENSOR_PROBE_QUIET_PERIOD * 1000;
+
+  assert(!probe_due(1000, 1000));
+  assert(!probe_due(1000 + quiet - 1, 1000));
+  assert(probe_due(1000 + quiet, 1000));
+  // Microsecond counter wrapping between the edge and the probe
+  assert(!probe_due(quiet / 2, UINT32_MAX - quiet / 4));
+  assert(probe_due(quiet, UINT32_MAX - quiet / 4));
+}
+
+static void test_probe_needs_consecutive_failures() {
+  probe_health_t health = {0};
+
+  for (int i = 1; i < SENSOR_PROBE_FAILURE_THRESHOLD; i++) {
+    assert(!probe_record(&health, PROBE_DISCONNECTED));
+    assert(!health.disconnected);
+  }
+
+  // A passing probe starts the count again
+  assert(!probe_record(&health, PROBE_CONNECTED));
+  for (int i = 1; i < SENSOR_PROBE_FAILURE_THRESHOLD; i++) {
+    assert(!probe_record(&health, PROBE_DISCONNECTED));
+  }
+
+  assert(probe_record(&health, PROBE_DISCONNECTED));
+  assert(health.disconnected);
+  // Only the change is reported
+  assert(!probe_record(&health, PROBE_DISCONNECTED));
+  assert(health.failed_probes == SENSOR_PROBE_FAILURE_THRESHOLD);
+}
+
+static void test_probe_ignores_inconclusive_results() {
+  probe_health_t health = {0};
+
+  assert(!probe_record(&health, PROBE_DISCONNECTED));
+  assert(!probe_record(&health, PROBE_INCONCLUSIVE));
+  assert(health.failed_probes == 1);
+}
+
+static void test_probe_reconnects_on_first_pass() {
+  probe_health_t health = {.failed_probes = SENSOR_PROBE_FAILURE_THRESHOLD,
+                           .disconnected = true};
+
+  assert(probe_record(&health, PROBE_CONNECTED));
+  assert(!health.disconnected);
+  assert(health.failed_probes == 0);
+}
+
+int main() {
+  RUN_TEST(test_probe_enabled_once_calibrated);
+  RUN_TEST(test_probe_classifies_rise);
+  RUN_TEST(test_probe_waits_for_quiet_period);
+  RUN_TEST(test_probe_needs_consecutive_failures);
+  RUN_TEST(test_probe_ignores_inconclusive_results);
+  RUN_TEST(test_probe_reconnects_on_first_pass);
+
+  return TEST_RESULT();
+}
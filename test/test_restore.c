@@ -0,0 +1,310 @@
+#include <assert.h>
+#include <espressif/esp_system.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "../machine.h"
+#include "../snapshot.h"
+#include "../timed_latch.h"
+#include "../transitions.h"
+#include "test.h"
+
+#define RELAY 5
+#define MOVEMENT_TIMEOUT 23000
+#define REVERSE_DELAY 2000
+#define MAX_TIMERS 4
+
+// Opening the door, stopping it part way and letting it reverse closed. Each
+// step leaves the sensors reading `door`.
+typedef struct step_t {
+  bool is_event;
+  machine_event_t event;
+  uint32_t advance;
+  machine_event_t door;
+} step_t;
+
+#define EVENT(e, d) {.is_event = true, .event = e, .door = d}
+#define ADVANCE(ms, d) {.advance = ms, .door = d}
+
+static const step_t g_steps[] = {
+    EVENT(MACHINE_INPUT_OPEN, MACHINE_DOOR_CLOSED),
+    EVENT(MACHINE_DOOR_MOVING, MACHINE_DOOR_MOVING),
+    ADVANCE(5000, MACHINE_DOOR_MOVING),
+    EVENT(MACHINE_INPUT_CLOSE, MACHINE_DOOR_MOVING),
+    ADVANCE(1000, MACHINE_DOOR_MOVING),
+    ADVANCE(1500, MACHINE_DOOR_MOVING),
+    ADVANCE(3000, MACHINE_DOOR_MOVING),
+    EVENT(MACHINE_DOOR_CLOSED, MACHINE_DOOR_CLOSED),
+};
+#define STEP_COUNT (int)(sizeof(g_steps) / sizeof(g_steps[0]))
+// Relay pulses for open, stop and reverse
+#define SCENARIO_RELAY_PULSES 3
+
+// What a run saw before it was reset, shared with the run after it
+typedef struct reset_point_t {
+  machine_state_t state;
+  uint32_t relay_pulses;
+  int timer_count;
+  uint32_t timers[MAX_TIMERS];
+  uint32_t restore_us;
+} reset_point_t;
+
+static reset_point_t *gp_point;
+
+static void share_rtc() {
+  gp_fake_rtc = mmap(NULL, sizeof(fake_rtc_t), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  gp_point = mmap(NULL, sizeof(reset_point_t), PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  assert(gp_fake_rtc != MAP_FAILED && gp_point != MAP_FAILED);
+  memset(gp_fake_rtc, 0, sizeof(fake_rtc_t));
+}
+
+// Runs a boot in a child process so the firmware's statics start from zero,
+// exactly as after a reset. Only RTC state and the shared reset point carry
+// over.
+static void in_boot(void (*boot)(int), int arg) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    fake_reboot();
+    boot(arg);
+    exit(0);
+  }
+
+  int status;
+  waitpid(pid, &status, 0);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+static void power_off(uint32_t reason, uint32_t ms) {
+  gp_fake_rtc->reset_reason = reason;
+  gp_fake_rtc->cycles += ms * 1000 / 5;
+}
+
+static uint32_t host_now_us() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// The same start up garage.c performs, with the sensors reading `door`
+static void boot(machine_event_t door) {
+  const machine_state_t initial_state_map[] = {
+      [MACHINE_DOOR_OPEN] = MACHINE_STATE_OPEN,
+      [MACHINE_DOOR_MOVING] = MACHINE_STATE_UNKNOWN,
+      [MACHINE_DOOR_CLOSED] = MACHINE_STATE_CLOSED,
+      [MACHINE_DOOR_UNKNOWN] = MACHINE_STATE_UNKNOWN,
+  };
+
+  uint32_t started = host_now_us();
+
+  timed_latch_init(RELAY, 100);
+  transition_start(MOVEMENT_TIMEOUT, REVERSE_DELAY, initial_state_map[door],
+                   NULL);
+  machine_handle_event(door);
+
+  gp_point->restore_us = host_now_us() - started;
+}
+
+static void run_steps(int from, int to) {
+  for (int i = from; i < to; i++) {
+    if (g_steps[i].is_event) {
+      machine_handle_event(g_steps[i].event);
+    } else {
+      fake_advance(g_steps[i].advance);
+    }
+  }
+}
+
+static void record_point() {
+  gp_point->state = machine_current_state();
+  gp_point->relay_pulses = fake_gpio_falls(RELAY);
+  gp_point->timer_count = fake_timer_remaining(gp_point->timers, MAX_TIMERS);
+}
+
+static void boot_and_run_until(int reset_after) {
+  boot(MACHINE_DOOR_CLOSED);
+  run_steps(0, reset_after);
+  record_point();
+}
+
+static uint32_t g_downtime;
+
+static void boot_after_reset(int reset_after) {
+  reset_point_t before = *gp_point;
+  machine_event_t door =
+      reset_after > 0 ? g_steps[reset_after - 1].door : MACHINE_DOOR_CLOSED;
+
+  boot(door);
+
+  // Resumed exactly where it left off, with the downtime taken off each timer
+  assert(machine_current_state() == before.state);
+
+  uint32_t timers[MAX_TIMERS];
+  assert(fake_timer_remaining(timers, MAX_TIMERS) == before.timer_count);
+  for (int i = 0; i < before.timer_count; i++) {
+    uint32_t expected =
+        before.timers[i] > g_downtime ? before.timers[i] - g_downtime : 1;
+    assert(timers[i] == expected);
+  }
+
+  // Booting never pulses the relay, and the rest of the scenario pulses it
+  // exactly as often as an uninterrupted run would
+  assert(fake_gpio_falls(RELAY) == 0);
+  run_steps(reset_after, STEP_COUNT);
+  fake_advance(MOVEMENT_TIMEOUT * 2);
+
+  assert(machine_current_state() == MACHINE_STATE_CLOSED);
+  assert(before.relay_pulses + fake_gpio_falls(RELAY) ==
+         SCENARIO_RELAY_PULSES);
+}
+
+static void test_restore_resumes_after_reset_at_any_step() {
+  const uint32_t downtimes[] = {0, 300, 1900};
+  uint32_t worst_restore_us = 0;
+
+  share_rtc();
+
+  for (int d = 0; d < sizeof(downtimes) / sizeof(downtimes[0]); d++) {
+    for (int reset_after = 0; reset_after <= STEP_COUNT; reset_after++) {
+      memset(gp_fake_rtc, 0, sizeof(fake_rtc_t));
+      g_downtime = downtimes[d];
+
+      in_boot(boot_and_run_until, reset_after);
+      power_off(WDT_RST, g_downtime);
+      in_boot(boot_after_reset, reset_after);
+
+      if (gp_point->restore_us > worst_restore_us) {
+        worst_restore_us = gp_point->restore_us;
+      }
+    }
+  }
+
+  fprintf(stderr, "  restore: %d reset points, worst restore time %uus\n",
+          (STEP_COUNT + 1) * 3, worst_restore_us);
+  // Needs to be well within the first few milliseconds of boot
+  assert(worst_restore_us < 1000);
+}
+
+static void boot_moving(int unused) {
+  boot(MACHINE_DOOR_MOVING);
+  record_point();
+}
+
+static void boot_open(int unused) {
+  boot(MACHINE_DOOR_OPEN);
+  record_point();
+}
+
+static void test_restore_ignores_external_reset() {
+  share_rtc();
+
+  in_boot(boot_and_run_until, 2);
+  assert(gp_point->state == MACHINE_STATE_OPENING);
+  power_off(EXT_RST, 100);
+  in_boot(boot_moving, 0);
+
+  assert(gp_point->state == MACHINE_STATE_UNKNOWN);
+  assert(gp_point->timer_count == 0);
+}
+
+static void test_restore_ignores_old_resting_state() {
+  share_rtc();
+
+  in_boot(boot_open, 0);
+  assert(gp_point->state == MACHINE_STATE_OPEN);
+  // Hours later the door reads between sensors, it must not be assumed to be
+  // closing
+  power_off(WDT_RST, 3 * 60 * 60 * 1000);
+  in_boot(boot_moving, 0);
+
+  assert(gp_point->state == MACHINE_STATE_UNKNOWN);
+  assert(gp_point->timer_count == 0);
+}
+
+static void test_restore_reconciles_with_sensors() {
+  share_rtc();
+
+  // Door started closing while the device was resetting
+  in_boot(boot_open, 0);
+  power_off(SOFT_RESTART, 200);
+  in_boot(boot_moving, 0);
+
+  assert(gp_point->state == MACHINE_STATE_CLOSING);
+  assert(gp_point->timer_count == 1);
+  assert(gp_point->timers[0] == MOVEMENT_TIMEOUT);
+}
+
+static void test_restore_does_not_reverse_long_stopped_door() {
+  share_rtc();
+
+  // Reset while stopped, then down for longer than the reverse grace period
+  in_boot(boot_and_run_until, 4);
+  assert(gp_point->state == MACHINE_STATE_STOPPED);
+  power_off(WDT_RST, REVERSE_DELAY + SNAPSHOT_GRACE_PERIOD + 1);
+  in_boot(boot_moving, 0);
+
+  assert(gp_point->state == MACHINE_STATE_UNKNOWN);
+  assert(gp_point->relay_pulses == 0);
+  assert(gp_point->timer_count == 0);
+}
+
+// Stopped part way, then pushed open by hand before the reverse delay passed
+static void boot_stop_and_reach_open(int unused) {
+  boot_and_run_until(4);
+  assert(gp_point->state == MACHINE_STATE_STOPPED);
+
+  machine_handle_event(MACHINE_DOOR_OPEN);
+  record_point();
+}
+
+static void boot_stop_reach_open_and_close(int unused) {
+  boot_stop_and_reach_open(0);
+
+  // The door starting to close inside the old reverse delay keeps its own
+  // movement timer
+  machine_handle_event(MACHINE_DOOR_MOVING);
+  fake_advance(REVERSE_DELAY + 500);
+  record_point();
+}
+
+static void test_restore_stopped_door_reaching_end_is_fresh() {
+  share_rtc();
+
+  in_boot(boot_stop_and_reach_open, 0);
+  assert(gp_point->state == MACHINE_STATE_OPEN);
+  assert(gp_point->timer_count == 0);
+
+  // Down for longer than the old reverse delay and its grace period, the door
+  // started closing meanwhile
+  power_off(WDT_RST, REVERSE_DELAY + SNAPSHOT_GRACE_PERIOD + 1);
+  in_boot(boot_moving, 0);
+
+  assert(gp_point->state == MACHINE_STATE_CLOSING);
+  assert(gp_point->relay_pulses == 0);
+  assert(gp_point->timer_count == 1);
+  assert(gp_point->timers[0] == MOVEMENT_TIMEOUT);
+}
+
+static void test_restore_stopped_door_reaching_end_keeps_movement_timer() {
+  share_rtc();
+
+  in_boot(boot_stop_reach_open_and_close, 0);
+
+  assert(gp_point->state == MACHINE_STATE_CLOSING);
+  assert(gp_point->timer_count == 1);
+  assert(gp_point->timers[0] == MOVEMENT_TIMEOUT - REVERSE_DELAY - 500);
+}
+
+int main() {
+  RUN_TEST(test_restore_resumes_after_reset_at_any_step);
+  RUN_TEST(test_restore_ignores_external_reset);
+  RUN_TEST(test_restore_ignores_old_resting_state);
+  RUN_TEST(test_restore_reconciles_with_sensors);
+  RUN_TEST(test_restore_does_not_reverse_long_stopped_door);
+  RUN_TEST(test_restore_stopped_door_reaching_end_is_fresh);
+  RUN_TEST(test_restore_stopped_door_reaching_end_keeps_movement_timer);
+
+  return TEST_RESULT();
+}
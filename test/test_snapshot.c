@@ -0,0 +1,142 @@
+#include <assert.h>
+#include <espressif/esp_system.h>
+#include <string.h>
+
+#include "../snapshot.h"
+#include "test.h"
+
+static const snapshot_t g_closing = {
+    .state = MACHINE_STATE_CLOSING,
+    .reverse_state = MACHINE_STATE_UNKNOWN,
+    .movement_remaining = 20000,
+};
+
+static const snapshot_t g_stopped = {
+    .state = MACHINE_STATE_STOPPED,
+    .reverse_state = MACHINE_STATE_OPENING,
+    .reverse_remaining = 1500,
+};
+
+static const snapshot_t g_open = {
+    .state = MACHINE_STATE_OPEN,
+    .reverse_state = MACHINE_STATE_UNKNOWN,
+};
+
+static void reset_after(uint32_t reason, uint32_t ms) {
+  fake_advance(ms);
+  gp_fake_rtc->reset_reason = reason;
+}
+
+static void test_snapshot_restores_after_watchdog_reset() {
+  snapshot_t snapshot;
+
+  snapshot_save(&g_closing);
+  reset_after(WDT_RST, 500);
+
+  assert(snapshot_restore(&snapshot));
+  assert(snapshot.state == MACHINE_STATE_CLOSING);
+  assert(snapshot.reverse_state == MACHINE_STATE_UNKNOWN);
+  assert(snapshot.movement_remaining == 19500);
+  assert(snapshot.reverse_remaining == 0);
+}
+
+static void test_snapshot_restores_only_firmware_resets() {
+  const uint32_t resumable[] = {WDT_RST, EXCEPTION_RST, SOFT_WDT_RST,
+                                SOFT_RESTART};
+  const uint32_t fresh[] = {DEFAULT_RST, DEEP_SLEEP_AWAKE, EXT_RST};
+  snapshot_t snapshot;
+
+  snapshot_save(&g_open);
+
+  for (int i = 0; i < sizeof(resumable) / sizeof(resumable[0]); i++) {
+    reset_after(resumable[i], 0);
+    assert(snapshot_restore(&snapshot));
+  }
+
+  for (int i = 0; i < sizeof(fresh) / sizeof(fresh[0]); i++) {
+    reset_after(fresh[i], 0);
+    assert(!snapshot_restore(&snapshot));
+  }
+}
+
+static void test_snapshot_rejects_missing_or_corrupt_record() {
+  snapshot_t snapshot;
+
+  reset_after(WDT_RST, 0);
+  assert(!snapshot_restore(&snapshot));
+
+  snapshot_save(&g_closing);
+  // A single bit flipped anywhere in the 28 byte record at block 64
+  for (int block = 64; block < 64 + 7; block++) {
+    for (int bit = 0; bit < 32; bit += 7) {
+      gp_fake_rtc->memory[block] ^= 1u << bit;
+      assert(!snapshot_restore(&snapshot));
+      gp_fake_rtc->memory[block] ^= 1u << bit;
+    }
+  }
+
+  assert(snapshot_restore(&snapshot));
+}
+
+static void test_snapshot_rejects_old_resting_state() {
+  snapshot_t snapshot;
+
+  snapshot_save(&g_open);
+  reset_after(WDT_RST, SNAPSHOT_MAX_AGE);
+  assert(snapshot_restore(&snapshot));
+
+  reset_after(WDT_RST, 1);
+  assert(!snapshot_restore(&snapshot));
+
+  // Hours later
+  reset_after(WDT_RST, 3 * 60 * 60 * 1000);
+  assert(!snapshot_restore(&snapshot));
+}
+
+static void test_snapshot_fires_recently_expired_timers() {
+  snapshot_t snapshot;
+
+  snapshot_save(&g_stopped);
+  reset_after(SOFT_WDT_RST,
+              g_stopped.reverse_remaining + SNAPSHOT_GRACE_PERIOD);
+
+  assert(snapshot_restore(&snapshot));
+  assert(snapshot.state == MACHINE_STATE_STOPPED);
+  assert(snapshot.reverse_state == MACHINE_STATE_OPENING);
+  assert(snapshot.reverse_remaining == 1);
+}
+
+static void test_snapshot_rejects_long_expired_timers() {
+  snapshot_t snapshot;
+
+  snapshot_save(&g_stopped);
+  reset_after(SOFT_WDT_RST,
+              g_stopped.reverse_remaining + SNAPSHOT_GRACE_PERIOD + 1);
+
+  assert(!snapshot_restore(&snapshot));
+}
+
+static void test_snapshot_survives_rtc_counter_wrap() {
+  snapshot_t snapshot;
+
+  gp_fake_rtc->cycles = UINT32_MAX - 1000;
+  snapshot_save(&g_closing);
+  reset_after(EXCEPTION_RST, 10000);
+
+  // The counter wrapped while the device was down
+  assert(gp_fake_rtc->cycles < UINT32_MAX - 1000);
+  assert(snapshot_restore(&snapshot));
+  assert(snapshot.movement_remaining == 10000);
+}
+
+int main() {
+  RUN_TEST(test_snapshot_restores_after_watchdog_reset);
+  RUN_TEST(test_snapshot_restores_only_firmware_resets);
+  RUN_TEST(test_snapshot_rejects_missing_or_corrupt_record);
+  RUN_TEST(test_snapshot_rejects_old_resting_state);
+  RUN_TEST(test_snapshot_fires_recently_expired_timers);
+  RUN_TEST(test_snapshot_rejects_long_expired_timers);
+  RUN_TEST(test_snapshot_survives_rtc_counter_wrap);
+
+  return TEST_RESULT();
+}
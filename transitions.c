@@ -1,9 +1,12 @@
 #include "transitions.h"
 
 #include <esplibs/libmain.h>
+#include <espressif/esp_system.h>
 #include <etstimer.h>
 #include <stdio.h>
 
+#include "budget.h"
+#include "snapshot.h"
 #include "timed_latch.h"
 
 const char *machine_state_description(machine_state_t machine_state) {
@@ -44,36 +47,78 @@ static uint16_t g_reverse_delay;
 static ETSTimer g_reverse_timer;
 static machine_state_t g_reverse_state = MACHINE_STATE_UNKNOWN;
 
+// Arm time and duration of each timer so they can be retained across resets,
+// a duration of 0 means disarmed
+static uint32_t g_movement_armed_at;
+static uint32_t g_movement_duration;
+static uint32_t g_reverse_armed_at;
+static uint32_t g_reverse_duration;
+
+static budget_site_t g_movement_timer_budget = BUDGET_SITE("movement timer");
+static budget_site_t g_reverse_timer_budget = BUDGET_SITE("reverse timer");
+
+static uint32_t transition_remaining(uint32_t armed_at, uint32_t duration) {
+  if (duration == 0) {
+    return 0;
+  }
+
+  uint32_t elapsed = (sdk_system_get_time() - armed_at) / 1000;
+
+  // Still armed until its handler runs
+  return duration > elapsed ? duration - elapsed : 1;
+}
+
+static void transition_arm_movement_timer_for(uint32_t duration) {
+  g_movement_armed_at = sdk_system_get_time();
+  g_movement_duration = duration;
+  sdk_os_timer_arm(&g_movement_timer, duration, false);
+}
+
 static void transition_arm_movement_timer() {
-  sdk_os_timer_arm(&g_movement_timer, g_movement_timeout, false);
+  transition_arm_movement_timer_for(g_movement_timeout);
 }
 
 static void transition_disarm_movement_timer() {
+  g_movement_duration = 0;
   sdk_os_timer_disarm(&g_movement_timer);
 }
 
 static void transition_handle_movement_timer() {
+  uint32_t started = budget_start();
   printf("Movement timer fired.\n");
   transition_disarm_movement_timer();
   machine_handle_event(MACHINE_TIMEOUT_MOVEMENT);
+  budget_stop(&g_movement_timer_budget, started);
+}
+
+static void transition_arm_reverse_timer_for(uint32_t duration) {
+  g_reverse_armed_at = sdk_system_get_time();
+  g_reverse_duration = duration;
+  sdk_os_timer_arm(&g_reverse_timer, duration, false);
 }
 
 static void transition_arm_reverse_timer() {
-  sdk_os_timer_arm(&g_reverse_timer, g_reverse_delay, false);
+  transition_arm_reverse_timer_for(g_reverse_delay);
 }
 
 static void transition_disarm_reverse_timer() {
+  g_reverse_duration = 0;
   sdk_os_timer_disarm(&g_reverse_timer);
 }
 
 static void transition_handle_reverse_timer() {
+  uint32_t started = budget_start();
   printf("Reverse timer fired.\n");
+  transition_disarm_reverse_timer();
   transition_disarm_movement_timer();
   machine_handle_event(MACHINE_TIMEOUT_REVERSE);
+  budget_stop(&g_reverse_timer_budget, started);
 }
 
 static machine_state_t transition_set_state_open(machine_state_t current_state,
                                                  machine_event_t event) {
+  // A stopped door that reached the end of its travel must not reverse
+  transition_disarm_reverse_timer();
   transition_disarm_movement_timer();
   return MACHINE_STATE_OPEN;
 }
@@ -81,6 +126,7 @@ static machine_state_t transition_set_state_open(machine_state_t current_state,
 static machine_state_t
 transition_set_state_closed(machine_state_t current_state,
                             machine_event_t event) {
+  transition_disarm_reverse_timer();
   transition_disarm_movement_timer();
   return MACHINE_STATE_CLOSED;
 }
@@ -102,6 +148,7 @@ transition_set_state_closing(machine_state_t current_state,
 static machine_state_t
 transition_set_state_unknown(machine_state_t current_state,
                              machine_event_t event) {
+  transition_disarm_movement_timer();
   return MACHINE_STATE_UNKNOWN;
 }
 
@@ -153,6 +200,7 @@ const machine_transition_fn
             {
                 [MACHINE_INPUT_CLOSE] = transition_stop_door,
                 [MACHINE_DOOR_OPEN] = transition_set_state_open,
+                [MACHINE_DOOR_UNKNOWN] = transition_set_state_unknown,
                 [MACHINE_TIMEOUT_MOVEMENT] = transition_set_state_unknown,
                 [MACHINE_DOOR_CLOSED] = transition_set_state_closed,
             },
@@ -166,6 +214,7 @@ const machine_transition_fn
             {
                 [MACHINE_INPUT_OPEN] = transition_stop_door,
                 [MACHINE_DOOR_OPEN] = transition_set_state_open,
+                [MACHINE_DOOR_UNKNOWN] = transition_set_state_unknown,
                 [MACHINE_TIMEOUT_MOVEMENT] = transition_set_state_unknown,
                 [MACHINE_DOOR_CLOSED] = transition_set_state_closed,
             },
@@ -185,7 +234,8 @@ const machine_transition_fn
             },
 };
 
-void transition_init(uint16_t movement_timeout, uint16_t reverse_delay) {
+static void transition_init(uint16_t movement_timeout,
+                            uint16_t reverse_delay) {
   g_movement_timeout = movement_timeout;
   g_reverse_delay = reverse_delay;
 
@@ -195,3 +245,46 @@ void transition_init(uint16_t movement_timeout, uint16_t reverse_delay) {
   transition_disarm_reverse_timer();
   sdk_os_timer_setfn(&g_reverse_timer, transition_handle_reverse_timer, NULL);
 }
+
+static void transition_restore(const snapshot_t *snapshot) {
+  g_reverse_state = snapshot->reverse_state;
+
+  if (snapshot->movement_remaining != 0) {
+    transition_arm_movement_timer_for(snapshot->movement_remaining);
+  }
+
+  if (snapshot->reverse_remaining != 0) {
+    transition_arm_reverse_timer_for(snapshot->reverse_remaining);
+  }
+}
+
+machine_state_t transition_start(uint16_t movement_timeout,
+                                 uint16_t reverse_delay,
+                                 machine_state_t initial_state,
+                                 machine_callback_fn on_transition) {
+  transition_init(movement_timeout, reverse_delay);
+
+  snapshot_t snapshot;
+  if (snapshot_restore(&snapshot)) {
+    transition_restore(&snapshot);
+    initial_state = snapshot.state;
+  }
+
+  machine_init(g_state_transition_matrix, initial_state, on_transition);
+  transition_retain(initial_state);
+
+  return initial_state;
+}
+
+void transition_retain(machine_state_t state) {
+  const snapshot_t snapshot = {
+      .state = state,
+      .reverse_state = g_reverse_state,
+      .movement_remaining =
+          transition_remaining(g_movement_armed_at, g_movement_duration),
+      .reverse_remaining =
+          transition_remaining(g_reverse_armed_at, g_reverse_duration),
+  };
+
+  snapshot_save(&snapshot);
+}
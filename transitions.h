@@ -9,6 +9,12 @@ extern const machine_transition_fn
 const char *machine_state_description(machine_state_t machine_state);
 const char *machine_event_description(machine_event_t machine_event);
 
-void transition_init(uint16_t movement_timeout, uint16_t reverse_delay);
+// Starts the machine from the state retained across a reset when it is usable,
+// otherwise from initial_state. Returns the state the machine started in.
+machine_state_t transition_start(uint16_t movement_timeout,
+                                 uint16_t reverse_delay,
+                                 machine_state_t initial_state,
+                                 machine_callback_fn on_transition);
+void transition_retain(machine_state_t state);
 
 #endif /* TRANSITIONS_H */